@@ -5,6 +5,7 @@
 #include "SPIFFS.h"
 #include <WiFi.h>
 #include <esp_camera.h>
+#include <esp_timer.h>
 
 class VideoFrameProvider {
 private:
@@ -18,9 +19,78 @@ private:
     uint32_t* frameSizes;
     uint32_t* frameOffsets;
     
-    // Frame rate control
-    unsigned long lastFrameTime;
-    unsigned long frameInterval; // in milliseconds
+    // Frame clock, shared by all consumers (RTSP sessions, MJPEG streams)
+    unsigned long lastFrameTime;  // time the current frame became due
+    unsigned long frameInterval;  // in milliseconds, adjustable at runtime
+    uint32_t frameSequence;       // incremented every time the clock advances, 0 is never used
+
+    // Live edge mode: the current frame is derived from a monotonic clock,
+    // (now - epoch) / interval, so frames are skipped after a stall instead of falling behind.
+    bool liveEdge;
+    int64_t epochTime;            // start of the current frame in microseconds
+
+    // Advance the frame clock when the next frame is due
+    void tick() {
+        if (liveEdge) {
+            tickLiveEdge();
+            return;
+        }
+
+        unsigned long currentTime = millis();
+        unsigned long interval = frameInterval;
+        if (currentTime - lastFrameTime < interval) {
+            return; // Not time for a new frame yet
+        }
+
+        // Keep the cadence; only resynchronize after a stall
+        lastFrameTime += interval;
+        if (currentTime - lastFrameTime >= interval) {
+            lastFrameTime = currentTime;
+        }
+
+        currentFrameIndex = (currentFrameIndex + 1) % numFrames;
+        if (++frameSequence == 0) {
+            frameSequence = 1;
+        }
+    }
+
+    // Skip to the frame at the live edge; frames are dropped rather than delayed
+    void tickLiveEdge() {
+        int64_t interval = (int64_t)frameInterval * 1000;
+        int64_t frames = (esp_timer_get_time() - epochTime) / interval;
+        if (frames <= 0) {
+            return; // Not time for a new frame yet
+        }
+
+        // Move the epoch to the start of the current frame so an interval change applies from here
+        epochTime += frames * interval;
+        lastFrameTime = epochTime / 1000;
+
+        currentFrameIndex = (currentFrameIndex + frames % numFrames) % numFrames;
+        frameSequence += frames;
+        if (frameSequence == 0) {
+            frameSequence = 1;
+        }
+    }
+
+    // Create a camera_fb_t structure to mimic the camera interface
+    camera_fb_t* createFrame(uint32_t index, unsigned long frameTime) {
+        camera_fb_t* fb = (camera_fb_t*)malloc(sizeof(camera_fb_t));
+        if (!fb) {
+            log_e("Failed to allocate memory for frame buffer structure");
+            return nullptr;
+        }
+
+        // Fill the structure with the frame data
+        fb->buf = frameBuffer + frameOffsets[index];
+        fb->len = frameSizes[index];
+        fb->width = 640;  // Assuming fixed resolution for now
+        fb->height = 480; // Assuming fixed resolution for now
+        fb->format = PIXFORMAT_JPEG;
+        fb->timestamp.tv_sec = frameTime / 1000;
+        fb->timestamp.tv_usec = (frameTime % 1000) * 1000;
+        return fb;
+    }
 
 public:
     VideoFrameProvider() : 
@@ -30,7 +100,10 @@ public:
         frameSizes(nullptr),
         frameOffsets(nullptr),
         lastFrameTime(0),
-        frameInterval(100) // Default 10 FPS
+        frameInterval(100), // Default 10 FPS
+        frameSequence(1),
+        liveEdge(false),
+        epochTime(0)
     {}
 
     ~VideoFrameProvider() {
@@ -45,11 +118,11 @@ public:
         }
     }
 
-    bool init(const char* videoFilePath, unsigned long interval) {
+    bool init(const char* videoFilePath, long interval) {
         log_i("Initializing VideoFrameProvider with file: %s", videoFilePath);
         
         // Set frame interval
-        frameInterval = interval;
+        setFrameDuration(interval);
         
         // Initialize SPIFFS
         if (!SPIFFS.begin(true)) {
@@ -128,36 +201,37 @@ public:
         return true;
     }
 
-    // Get the next frame
+    // Get the current frame, e.g. for a snapshot
     camera_fb_t* getFrame() {
-        // Check if it's time for a new frame based on frame rate
-        unsigned long currentTime = millis();
-        if (currentTime - lastFrameTime < frameInterval) {
-            return nullptr; // Not time for a new frame yet
+        if (numFrames == 0) {
+            return nullptr;
         }
-        
-        lastFrameTime = currentTime;
-        
-        // Create a camera_fb_t structure to mimic the camera interface
-        camera_fb_t* fb = (camera_fb_t*)malloc(sizeof(camera_fb_t));
-        if (!fb) {
-            log_e("Failed to allocate memory for frame buffer structure");
+
+        tick();
+        return createFrame(currentFrameIndex, lastFrameTime);
+    }
+
+    // Get the current frame if it differs from the one last seen by the consumer.
+    // Every consumer keeps its own sequence so all of them observe the same clock.
+    // A new consumer starts with sequence 0 and gets the current frame immediately.
+    camera_fb_t* getNextFrame(uint32_t& lastSequence) {
+        if (numFrames == 0) {
             return nullptr;
         }
-        
-        // Fill the structure with the current frame data
-        fb->buf = frameBuffer + frameOffsets[currentFrameIndex];
-        fb->len = frameSizes[currentFrameIndex];
-        fb->width = 640;  // Assuming fixed resolution for now
-        fb->height = 480; // Assuming fixed resolution for now
-        fb->format = PIXFORMAT_JPEG;
-        fb->timestamp.tv_sec = currentTime / 1000;
-        fb->timestamp.tv_usec = (currentTime % 1000) * 1000;
-        
-        // Move to the next frame
-        currentFrameIndex = (currentFrameIndex + 1) % numFrames;
-        
-        return fb;
+
+        tick();
+        if (frameSequence == lastSequence) {
+            return nullptr; // Not time for a new frame yet
+        }
+
+        lastSequence = frameSequence;
+        return createFrame(currentFrameIndex, lastFrameTime);
+    }
+
+    // Presentation time of a frame in milliseconds (frame clock, not wall clock)
+    static unsigned long frameTime(const camera_fb_t* fb) {
+        // time_t is 32 bit signed; multiply as unsigned long to avoid overflow after 24.8 days
+        return (unsigned long)fb->timestamp.tv_sec * 1000 + fb->timestamp.tv_usec / 1000;
     }
 
     // Release a frame (to mimic esp_camera_fb_return)
@@ -167,6 +241,11 @@ public:
         }
     }
 
+    // Frame duration in milliseconds as used by the frame clock
+    unsigned long getFrameDuration() {
+        return frameInterval;
+    }
+
     // Utility to get current frames per second
     float getCurrentFps() {
         return 1000.0f / frameInterval;
@@ -175,6 +254,33 @@ public:
     // Set frames per second
     void setFps(float fps) {
         if (fps <= 0) fps = 10.0f; // Fallback to 10 FPS
-        frameInterval = 1000.0f / fps;
+        setFrameDuration(1000.0f / fps);
+    }
+
+    // Set the frame duration in milliseconds. Takes effect on the next frame for all consumers.
+    // Negative values (e.g. parsed from the configuration) fall back to 10 FPS.
+    void setFrameDuration(long interval) {
+        if (interval <= 0) interval = 100; // Fallback to 10 FPS
+        if (interval > 10000) interval = 10000; // At least one frame every 10 s
+        // Account for the time elapsed so far using the old interval
+        if (numFrames > 0) {
+            tick();
+        }
+
+        frameInterval = interval;
+    }
+
+    // Enable or disable the live edge mode. When enabled, the current frame starts now.
+    void setLiveEdge(bool enable) {
+        if (enable && !liveEdge) {
+            epochTime = esp_timer_get_time();
+            lastFrameTime = epochTime / 1000;
+        }
+
+        liveEdge = enable;
+    }
+
+    bool isLiveEdge() {
+        return liveEdge;
     }
 };
\ No newline at end of file
@@ -5,9 +5,10 @@
 
 #define WIFI_SSID "ESP32S3-Video-RTSP"
 #define WIFI_PASSWORD nullptr
-#define CONFIG_VERSION "1.0"
+#define CONFIG_VERSION "1.1"
 
 #define RTSP_PORT 554
 
 #define DEFAULT_FRAME_DURATION 100  // 10 FPS
-#define DEFAULT_JPEG_QUALITY 80     // Good quality/size balance
\ No newline at end of file
+#define DEFAULT_JPEG_QUALITY 80     // Good quality/size balance
+#define DEFAULT_LIVE_EDGE false     // Skip frames after a stall to stay on the wall clock
\ No newline at end of file
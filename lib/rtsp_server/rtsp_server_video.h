@@ -13,23 +13,27 @@ class VideoStreamer : public CStreamer
 {
 private:
     VideoFrameProvider& videoProvider;
+    // Sequence of the last frame sent to this session
+    uint32_t frameSequence;
     
 public:
     // Fix: Looking at the actual CStreamer constructor in Micro-RTSP
     VideoStreamer(SOCKET aClient, VideoFrameProvider& provider) 
         : CStreamer(aClient, 640, 480), // Fixed width & height for streaming
-          videoProvider(provider)
+          videoProvider(provider),
+          frameSequence(0)
     {
     }
     
     virtual void streamImage(uint32_t curMsec)
     {
-        // Get a frame from the video provider
-        auto fb = videoProvider.getFrame();
+        // Get a new frame from the video provider, if due
+        auto fb = videoProvider.getNextFrame(frameSequence);
         if (fb)
         {
-            // Stream the JPEG frame
-            streamFrame(fb->buf, fb->len, curMsec);
+            // Stream the JPEG frame. The RTP timestamp is taken from the frame clock
+            // so it stays continuous when the frame rate changes.
+            streamFrame(fb->buf, fb->len, VideoFrameProvider::frameTime(fb));
             
             // Return the frame buffer
             videoProvider.returnFrame(fb);
@@ -40,12 +44,15 @@ public:
 class rtsp_server_video : public WiFiServer
 {
 public:
-    rtsp_server_video(VideoFrameProvider& provider, unsigned long interval, int port = 554)
+    // Sessions are polled at a fixed rate; the frame rate is determined by the video provider
+    static const unsigned long poll_interval = 5; // in milliseconds
+
+    rtsp_server_video(VideoFrameProvider& provider, int port = 554)
         : WiFiServer(port), videoProvider_(provider)
     {
         log_i("Starting RTSP server for video");
         WiFiServer::begin();
-        timer_.every(interval, client_handler, this);
+        timer_.every(poll_interval, client_handler, this);
     }
     
     size_t num_connected()
@@ -96,7 +103,7 @@ private:
         {
             // Handle requests
             client->session->handleRequests(0);
-            // Send the frame. For now return the uptime as time marker, currMs
+            // Send the frame if a new one is due. The time marker is ignored by the streamer
             client->session->broadcastCurrentFrame(now);
         }
         
@@ -1,6 +1,7 @@
 #!/usr/bin/python3
 
 import sys
+import gzip
 import minify_html
 
 if (len(sys.argv) <= 2):
@@ -17,4 +18,11 @@ html_minified = minify_html.minify(html, minify_css=True)
 output_file.write(html_minified)
 
 output_file.close()
+
+# Pre-compressed copy that is embedded in the firmware and served as-is.
+# mtime=0 keeps the output (and the ETag derived from it) reproducible.
+gzip_file = open(sys.argv[2] + '.gz', 'wb')
+gzip_file.write(gzip.compress(html_minified.encode('utf-8'), 9, mtime=0))
+gzip_file.close()
+
 print('Done.')
\ No newline at end of file
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+import argparse
+import collections
+import hashlib
+import socket
+import statistics
+import struct
+import threading
+import time
+
+def read_response(sock, buffer):
+    """
+    Read an RTSP response, return (headers, remaining buffer)
+    """
+    while b'\r\n\r\n' not in buffer:
+        data = sock.recv(4096)
+        if not data:
+            raise ConnectionError("Connection closed by the server")
+        buffer += data
+
+    header, buffer = buffer.split(b'\r\n\r\n', 1)
+    lines = header.decode('ascii', 'replace').split('\r\n')
+    if not lines[0].startswith('RTSP/1.0 200'):
+        raise ConnectionError(f"Unexpected response: {lines[0]}")
+
+    headers = {}
+    for line in lines[1:]:
+        key, _, value = line.partition(':')
+        headers[key.strip().lower()] = value.strip()
+
+    # Skip the body (SDP of DESCRIBE)
+    length = int(headers.get('content-length', 0))
+    while len(buffer) < length:
+        data = sock.recv(4096)
+        if not data:
+            raise ConnectionError("Connection closed by the server")
+        buffer += data
+
+    return headers, buffer[length:]
+
+def rtsp_request(sock, buffer, method, url, cseq, extra=''):
+    sock.sendall(f"{method} {url} RTSP/1.0\r\nCSeq: {cseq}\r\n{extra}\r\n".encode('ascii'))
+    return read_response(sock, buffer)
+
+def read_exact(sock, buffer, length):
+    while len(buffer) < length:
+        data = sock.recv(65536)
+        if not data:
+            raise ConnectionError("Connection closed by the server")
+        buffer += data
+    return buffer[:length], buffer[length:]
+
+def frame_key(data):
+    """
+    Identify a frame by the end of its JPEG scan data; the same for RTSP and MJPEG
+    """
+    if data.endswith(b'\xff\xd9'):
+        data = data[:-2]
+    return hashlib.sha1(data[-32:]).hexdigest()
+
+def run_client(host, port, duration, result):
+    """
+    Join the RTSP stream (RTP over TCP) and record the arrival of every frame
+    """
+    url = f"rtsp://{host}:{port}/mjpeg/1"
+    sock = socket.create_connection((host, port), timeout=10)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    buffer = b''
+
+    _, buffer = rtsp_request(sock, buffer, 'OPTIONS', url, 1)
+    _, buffer = rtsp_request(sock, buffer, 'DESCRIBE', url, 2, 'Accept: application/sdp\r\n')
+    headers, buffer = rtsp_request(sock, buffer, 'SETUP', url, 3, 'Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n')
+    session = headers.get('session', '').split(';')[0]
+
+    play_time = time.monotonic()
+    _, buffer = rtsp_request(sock, buffer, 'PLAY', url, 4, f"Session: {session}\r\n")
+    result['start'] = play_time
+
+    frames = []
+    first_packet = None
+    end_time = play_time + duration
+    while time.monotonic() < end_time:
+        # Interleaved frame: '$', channel, length
+        header, buffer = read_exact(sock, buffer, 4)
+        if header[0:1] != b'$':
+            raise ConnectionError("Lost interleaved framing")
+        channel, length = struct.unpack('>BH', header[1:4])
+        packet, buffer = read_exact(sock, buffer, length)
+        if channel != 0 or length < 12:
+            continue
+
+        if first_packet is None:
+            first_packet = time.monotonic()
+
+        # RTP header (12 bytes), JPEG header (8 bytes) followed by the JPEG data.
+        # The marker is set on the last packet of a frame.
+        marker = packet[1] & 0x80
+        if marker:
+            rtp_timestamp = struct.unpack('>I', packet[4:8])[0]
+            frames.append((time.monotonic(), frame_key(packet[20:]), rtp_timestamp))
+
+    try:
+        sock.sendall(f"TEARDOWN {url} RTSP/1.0\r\nCSeq: 5\r\nSession: {session}\r\n\r\n".encode('ascii'))
+    except OSError:
+        pass
+    sock.close()
+
+    result['first_packet'] = first_packet
+    result['frames'] = frames
+
+def run_mjpeg_client(host, port, duration, result):
+    """
+    Join the JPEG motion stream and record the arrival of every frame
+    """
+    sock = socket.create_connection((host, port), timeout=10)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    start_time = time.monotonic()
+    sock.sendall(f"GET /stream HTTP/1.1\r\nHost: {host}\r\n\r\n".encode('ascii'))
+    result['start'] = start_time
+
+    frames = []
+    first_packet = None
+    buffer = b''
+    end_time = start_time + duration
+    while time.monotonic() < end_time:
+        # Every part has a Content-Length header followed by the JPEG
+        while b'Content-Length:' not in buffer or b'\r\n\r\n' not in buffer[buffer.index(b'Content-Length:'):]:
+            data = sock.recv(65536)
+            if not data:
+                raise ConnectionError("Connection closed by the server")
+            if first_packet is None:
+                first_packet = time.monotonic()
+            buffer += data
+
+        header_start = buffer.index(b'Content-Length:')
+        header_end = buffer.index(b'\r\n\r\n', header_start)
+        length = int(buffer[header_start + len(b'Content-Length:'):header_end].split(b'\r\n')[0])
+        jpeg, buffer = read_exact(sock, buffer[header_end + 4:], length)
+        frames.append((time.monotonic(), frame_key(jpeg), None))
+
+    sock.close()
+
+    result['first_packet'] = first_packet
+    result['frames'] = frames
+
+def unique_frames(frames):
+    """
+    Arrival time of the frames that were received exactly once
+    """
+    counts = collections.Counter(digest for _, digest, _ in frames)
+    return {digest: arrival for arrival, digest, _ in frames if counts[digest] == 1}
+
+def cross_client_skew(frames_a, frames_b):
+    """
+    For every frame of client a, the arrival difference of the same frame at client b.
+    Repeated (static or looped) frames are ambiguous and are not used.
+    """
+    unique_a = unique_frames(frames_a)
+    unique_b = unique_frames(frames_b)
+    return [unique_b[digest] - arrival for digest, arrival in unique_a.items() if digest in unique_b]
+
+def ms(seconds):
+    return f"{seconds * 1000:.1f} ms"
+
+def main():
+    parser = argparse.ArgumentParser(description='Measure RTSP / JPEG motion join latency and frame skew between clients')
+    parser.add_argument('host', help='IP address or host name of the device')
+    parser.add_argument('--port', type=int, default=554, help='RTSP port')
+    parser.add_argument('--http-port', type=int, default=80, help='HTTP port (JPEG motion stream)')
+    parser.add_argument('--clients', type=int, default=3, help='Number of concurrent RTSP clients')
+    parser.add_argument('--mjpeg-clients', type=int, default=1, help='Number of concurrent JPEG motion clients')
+    parser.add_argument('--stagger', type=float, default=0.37, help='Delay between clients joining (s)')
+    parser.add_argument('--duration', type=float, default=5.0, help='Time each client stays connected (s)')
+
+    args = parser.parse_args()
+
+    # RTSP and JPEG motion clients join alternately
+    clients = [('RTSP', run_client, args.port)] * args.clients
+    for i in range(args.mjpeg_clients):
+        clients.insert(2 * i + 1, ('MJPEG', run_mjpeg_client, args.http_port))
+
+    results = [{'protocol': protocol} for protocol, _, _ in clients]
+    threads = []
+    for (_, target, port), result in zip(clients, results):
+        thread = threading.Thread(target=target, args=(args.host, port, args.duration, result))
+        thread.start()
+        threads.append(thread)
+        time.sleep(args.stagger)
+
+    for thread in threads:
+        thread.join()
+
+    print(f"Streams: rtsp://{args.host}:{args.port}/mjpeg/1, http://{args.host}:{args.http_port}/stream")
+    latencies = []
+    for i, result in enumerate(results):
+        frames = result.get('frames')
+        if not frames:
+            print(f"Client {i} ({result['protocol']}): no frames received")
+            continue
+
+        # Join latency: PLAY / GET sent until the first complete frame is received
+        latency = frames[0][0] - result['start']
+        latencies.append(latency)
+        # Frame interval as seen from the RTP timestamps (90 kHz clock) or the arrival times
+        if frames[0][2] is not None:
+            deltas = [((b[2] - a[2]) & 0xFFFFFFFF) / 90000 for a, b in zip(frames, frames[1:])]
+        else:
+            deltas = [b[0] - a[0] for a, b in zip(frames, frames[1:])]
+        interval = ms(statistics.mean(deltas)) if deltas else 'n/a'
+        print(f"Client {i} ({result['protocol']}): join latency {ms(latency)} (first packet {ms(result['first_packet'] - result['start'])}), "
+              f"{len(frames)} frames, frame interval {interval}")
+
+    if latencies:
+        print(f"Join latency: median {ms(statistics.median(latencies))}, max {ms(max(latencies))}")
+
+    # With live edge enabled, the same frame should arrive at all clients at (about) the same time
+    skews = []
+    for i in range(len(results)):
+        for j in range(i + 1, len(results)):
+            skews += cross_client_skew(results[i].get('frames', []), results[j].get('frames', []))
+    if skews:
+        skews = [abs(skew) for skew in skews]
+        print(f"Frame skew between clients: median {ms(statistics.median(skews))}, max {ms(max(skews))} ({len(skews)} frames)")
+    else:
+        print("Frame skew between clients: no unique frames received by multiple clients "
+              "(video loop shorter than --duration or repeated frames)")
+
+if __name__ == "__main__":
+    main()
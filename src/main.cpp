@@ -6,19 +6,22 @@
 #include "FS.h"
 #include "SPIFFS.h"
 #include <WiFi.h>
+#include <list>
 #include "VideoFrameProvider.h" 
 #include "rtsp_server_video.h"  
-#include <format_duration.h>
-#include <format_number.h>
-#include <moustache.h>
 #include <settings.h>
 
-// HTML files
-extern const char index_html_min_start[] asm("_binary_html_index_min_html_start");
+// HTML files (gzip compressed, embedded by the build)
+extern const uint8_t index_html_min_gz_start[] asm("_binary_html_index_min_html_gz_start");
+extern const uint8_t index_html_min_gz_end[] asm("_binary_html_index_min_html_gz_end");
+
+// ETag of the embedded index page, calculated once at startup
+char index_html_etag[12];
 
 // Parameter values storage
 char param_frame_duration_value[12]; // Enough for a number up to 9999
 char param_video_quality_value[4];   // Enough for a number up to 100
+char param_live_edge_value[IOTWEBCONF_WORD_LEN];
 
 // Parameter groups and parameters - fixed to use standard IotWebConf parameters
 iotwebconf::ParameterGroup param_group_video("video", "Video settings");
@@ -29,6 +32,10 @@ iotwebconf::NumberParameter param_frame_duration("fd", "Frame duration (ms)",
 iotwebconf::NumberParameter param_video_quality("q", "Video quality", 
                                               param_video_quality_value, 
                                               sizeof(param_video_quality_value));
+iotwebconf::CheckboxParameter param_live_edge("Live edge (skip frames to stay on the wall clock)", "le",
+                                              param_live_edge_value,
+                                              sizeof(param_live_edge_value),
+                                              DEFAULT_LIVE_EDGE);
 
 // Video Frame Provider
 VideoFrameProvider videoProvider;
@@ -49,6 +56,16 @@ IotWebConf iotWebConf(thingName.c_str(), &dnsServer, &web_server, WIFI_PASSWORD,
 // Initialization result
 esp_err_t video_init_result = ESP_OK;
 
+void calculate_index_html_etag()
+{
+  // FNV-1a hash over the compressed page; changes only when the firmware does
+  uint32_t hash = 2166136261u;
+  for (auto p = index_html_min_gz_start; p < index_html_min_gz_end; ++p)
+    hash = (hash ^ *p) * 16777619u;
+
+  snprintf(index_html_etag, sizeof(index_html_etag), "\"%08x\"", (unsigned)hash);
+}
+
 void handle_root()
 {
   log_v("Handle root");
@@ -56,70 +73,168 @@ void handle_root()
   if (iotWebConf.handleCaptivePortal())
     return;
 
-  // Format hostname
-  auto hostname = "esp32-" + WiFi.macAddress() + ".local";
-  hostname.replace(":", "");
-  hostname.toLowerCase();
+  // The page is static; live values are retrieved by the page from /api/status.
+  // no-cache makes the browser revalidate with the ETag, so a reflashed page is picked up.
+  web_server.sendHeader("Cache-Control", "no-cache");
+  web_server.sendHeader("ETag", index_html_etag);
+  if (web_server.header("If-None-Match") == index_html_etag)
+  {
+    web_server.send(304);
+    return;
+  }
+
+  web_server.sendHeader("Content-Encoding", "gzip");
+  web_server.send_P(200, "text/html", (PGM_P)index_html_min_gz_start, index_html_min_gz_end - index_html_min_gz_start);
+}
+
+// Copy a string into a buffer, escaped to be used as a JSON string value
+const char *json_escape(char *buffer, size_t size, const char *value)
+{
+  size_t len = 0;
+  for (; *value != '\0' && len + 7 < size; ++value)
+  {
+    auto c = (unsigned char)*value;
+    if (c == '"' || c == '\\')
+    {
+      buffer[len++] = '\\';
+      buffer[len++] = c;
+    }
+    else if (c < 0x20)
+      len += snprintf(buffer + len, size - len, "\\u%04x", c);
+    else
+      buffer[len++] = c;
+  }
+
+  buffer[len] = '\0';
+  return buffer;
+}
+
+void handle_api_status()
+{
+  log_v("handle_api_status");
+  // Everything is formatted into stack buffers to avoid heap allocations on every poll
+  char thing_name[2 * IOTWEBCONF_WORD_LEN];
+  json_escape(thing_name, sizeof(thing_name), iotWebConf.getThingName());
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  char mac_address[18];
+  snprintf(mac_address, sizeof(mac_address), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  char hostname[32];
+  snprintf(hostname, sizeof(hostname), "esp32-%02x%02x%02x%02x%02x%02x.local", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  // Access point information (without the String allocations of WiFi.SSID())
+  char access_point[2 * sizeof(wifi_ap_record_t::ssid)] = "";
+  wifi_ap_record_t ap_info;
+  if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK)
+    json_escape(access_point, sizeof(access_point), (const char *)ap_info.ssid);
 
   // Wifi Modes
   const char *wifi_modes[] = {"NULL", "STA", "AP", "STA+AP"};
-  auto ipv4 = WiFi.getMode() == WIFI_MODE_AP ? WiFi.softAPIP() : WiFi.localIP();
-  auto ipv6 = WiFi.getMode() == WIFI_MODE_AP ? WiFi.softAPIPv6() : WiFi.localIPv6();
+  auto ap_mode = WiFi.getMode() == WIFI_MODE_AP;
+  auto ipv4 = ap_mode ? WiFi.softAPIP() : WiFi.localIP();
+  char ipv4_address[16];
+  snprintf(ipv4_address, sizeof(ipv4_address), "%u.%u.%u.%u", ipv4[0], ipv4[1], ipv4[2], ipv4[3]);
+  auto ipv6 = ap_mode ? WiFi.softAPIPv6() : WiFi.localIPv6();
+  const uint8_t *ip6 = ipv6;
+  char ipv6_address[40];
+  snprintf(ipv6_address, sizeof(ipv6_address), "%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x",
+           ip6[0], ip6[1], ip6[2], ip6[3], ip6[4], ip6[5], ip6[6], ip6[7],
+           ip6[8], ip6[9], ip6[10], ip6[11], ip6[12], ip6[13], ip6[14], ip6[15]);
+
+  // Frame duration as used by the frame clock (the configured value may be out of range)
+  unsigned long frameDuration = videoProvider.getFrameDuration();
 
   // Get numeric values from the parameter strings
-  unsigned long frameDuration = DEFAULT_FRAME_DURATION;
-  byte videoQuality = DEFAULT_JPEG_QUALITY;
-  
+  int videoQuality = DEFAULT_JPEG_QUALITY;
+
   // Parse the parameters from strings to numbers
-  if (strlen(param_frame_duration_value) > 0) {
-    frameDuration = atol(param_frame_duration_value);
-  }
-  
   if (strlen(param_video_quality_value) > 0) {
     videoQuality = atoi(param_video_quality_value);
   }
 
-  moustache_variable_t substitutions[] = {
-      // Version / CPU
-      {"AppTitle", APP_TITLE},
-      {"AppVersion", APP_VERSION},
-      {"BoardType", BOARD_NAME},
-      {"ThingName", iotWebConf.getThingName()},
-      {"SDKVersion", ESP.getSdkVersion()},
-      {"ChipModel", ESP.getChipModel()},
-      {"ChipRevision", String(ESP.getChipRevision())},
-      {"CpuFreqMHz", String(ESP.getCpuFreqMHz())},
-      {"CpuCores", String(ESP.getChipCores())},
-      {"FlashSize", format_memory(ESP.getFlashChipSize(), 0)},
-      {"HeapSize", format_memory(ESP.getHeapSize())},
-      {"PsRamSize", format_memory(ESP.getPsramSize(), 0)},
-      // Diagnostics
-      {"Uptime", String(format_duration(millis() / 1000))},
-      {"FreeHeap", format_memory(ESP.getFreeHeap())},
-      {"MaxAllocHeap", format_memory(ESP.getMaxAllocHeap())},
-      {"NumRTSPSessions", video_server != nullptr ? String(video_server->num_connected()) : "RTSP server disabled"},
-      // Network
-      {"HostName", hostname},
-      {"MacAddress", WiFi.macAddress()},
-      {"AccessPoint", WiFi.SSID()},
-      {"SignalStrength", String(WiFi.RSSI())},
-      {"WifiMode", wifi_modes[WiFi.getMode()]},
-      {"IPv4", ipv4.toString()},
-      {"IPv6", ipv6.toString()},
-      {"NetworkState.ApMode", String(iotWebConf.getState() == iotwebconf::NetworkState::ApMode)},
-      {"NetworkState.OnLine", String(iotWebConf.getState() == iotwebconf::NetworkState::OnLine)},
-      // Video
-      {"FrameDuration", String(frameDuration)},
-      {"FrameFrequency", String(1000.0 / frameDuration, 1)},
-      {"VideoQuality", String(videoQuality)},
-      {"VideoInitialized", String(video_init_result == ESP_OK)},
-      // RTSP
-      {"RtspPort", String(RTSP_PORT)}
-  };
+  char rtsp_sessions[12] = "null";
+  if (video_server != nullptr)
+    snprintf(rtsp_sessions, sizeof(rtsp_sessions), "%u", (unsigned)video_server->num_connected());
+
+  auto state = iotWebConf.getState();
+
+  char json[1024];
+  auto len = snprintf(json, sizeof(json),
+                      "{"
+                      // Version / CPU
+                      "\"AppTitle\":\"" APP_TITLE "\","
+                      "\"AppVersion\":\"" APP_VERSION "\","
+                      "\"BoardType\":\"" BOARD_NAME "\","
+                      "\"ThingName\":\"%s\","
+                      "\"SDKVersion\":\"%s\","
+                      "\"ChipModel\":\"%s\","
+                      "\"ChipRevision\":%u,"
+                      "\"CpuFreqMHz\":%lu,"
+                      "\"CpuCores\":%u,"
+                      "\"FlashSize\":%lu,"
+                      "\"HeapSize\":%lu,"
+                      "\"PsRamSize\":%lu,"
+                      // Diagnostics
+                      "\"Uptime\":%lu,"
+                      "\"FreeHeap\":%lu,"
+                      "\"MaxAllocHeap\":%lu,"
+                      "\"NumRTSPSessions\":%s,"
+                      // Network
+                      "\"HostName\":\"%s\","
+                      "\"MacAddress\":\"%s\","
+                      "\"AccessPoint\":\"%s\","
+                      "\"SignalStrength\":%d,"
+                      "\"WifiMode\":\"%s\","
+                      "\"IPv4\":\"%s\","
+                      "\"IPv6\":\"%s\","
+                      "\"ApMode\":%s,"
+                      "\"OnLine\":%s,"
+                      // Video
+                      "\"FrameDuration\":%lu,"
+                      "\"VideoQuality\":%d,"
+                      "\"LiveEdge\":%s,"
+                      "\"VideoInitialized\":%s,"
+                      // RTSP
+                      "\"RtspPort\":%d"
+                      "}",
+                      thing_name,
+                      ESP.getSdkVersion(),
+                      ESP.getChipModel(),
+                      (unsigned)ESP.getChipRevision(),
+                      (unsigned long)ESP.getCpuFreqMHz(),
+                      (unsigned)ESP.getChipCores(),
+                      (unsigned long)ESP.getFlashChipSize(),
+                      (unsigned long)ESP.getHeapSize(),
+                      (unsigned long)ESP.getPsramSize(),
+                      millis() / 1000,
+                      (unsigned long)ESP.getFreeHeap(),
+                      (unsigned long)ESP.getMaxAllocHeap(),
+                      rtsp_sessions,
+                      hostname,
+                      mac_address,
+                      access_point,
+                      (int)WiFi.RSSI(),
+                      wifi_modes[WiFi.getMode()],
+                      ipv4_address,
+                      ipv6_address,
+                      state == iotwebconf::NetworkState::ApMode ? "true" : "false",
+                      state == iotwebconf::NetworkState::OnLine ? "true" : "false",
+                      frameDuration,
+                      videoQuality,
+                      videoProvider.isLiveEdge() ? "true" : "false",
+                      video_init_result == ESP_OK ? "true" : "false",
+                      RTSP_PORT);
+
+  if (len < 0 || (size_t)len >= sizeof(json))
+  {
+    log_e("Status JSON does not fit in the buffer");
+    web_server.send(500, "text/plain", "Status too large");
+    return;
+  }
 
   web_server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  auto html = moustache_render(index_html_min_start, substitutions);
-  web_server.send(200, "text/html", html);
+  web_server.send_P(200, "application/json", json, len);
 }
 
 void handle_snapshot()
@@ -150,6 +265,16 @@ void handle_snapshot()
 
 #define STREAM_CONTENT_BOUNDARY "123456789000000000000987654321"
 
+// MJPEG stream clients, served from loop() so streaming does not block the web server
+struct mjpeg_client
+{
+  WiFiClient client;
+  // Sequence of the last frame sent to this client
+  uint32_t frameSequence;
+};
+
+std::list<mjpeg_client> mjpeg_clients;
+
 void handle_stream()
 {
   log_v("handle_stream");
@@ -160,46 +285,55 @@ void handle_stream()
   }
 
   log_v("starting streaming");
-  // Blocks further handling of HTTP server until stopped
-  char size_buf[12];
+  // Keep a copy of the connection; the frames are sent by stream_mjpeg_clients()
   auto client = web_server.client();
   client.write("HTTP/1.1 200 OK\r\nAccess-Control-Allow-Origin: *\r\nContent-Type: multipart/x-mixed-replace; boundary=" STREAM_CONTENT_BOUNDARY "\r\n");
-  
-  while (client.connected())
+  mjpeg_clients.push_back({client, 0});
+}
+
+void stream_mjpeg_clients()
+{
+  char size_buf[12];
+  for (auto &mjpeg : mjpeg_clients)
   {
-    // Get a frame
-    auto fb = videoProvider.getFrame();
-    if (fb) {
-      client.write("\r\n--" STREAM_CONTENT_BOUNDARY "\r\n");
-      client.write("Content-Type: image/jpeg\r\nContent-Length: ");
-      sprintf(size_buf, "%d\r\n\r\n", fb->len);
-      client.write(size_buf);
-      client.write((const char*)fb->buf, fb->len);
-      
+    if (!mjpeg.client.connected())
+      continue;
+
+    // Get a new frame, if due
+    auto fb = videoProvider.getNextFrame(mjpeg.frameSequence);
+    if (fb)
+    {
+      mjpeg.client.write("\r\n--" STREAM_CONTENT_BOUNDARY "\r\n");
+      mjpeg.client.write("Content-Type: image/jpeg\r\nContent-Length: ");
+      sprintf(size_buf, "%u\r\n\r\n", (unsigned)fb->len);
+      mjpeg.client.write(size_buf);
+      mjpeg.client.write((const char *)fb->buf, fb->len);
+
       // Return the frame buffer
       videoProvider.returnFrame(fb);
     }
-    
-    // Short delay to control frame rate
-    delay(10);
   }
 
-  log_v("client disconnected");
-  client.stop();
-  log_v("stopped streaming");
+  mjpeg_clients.remove_if([](mjpeg_client &c)
+                          {
+                            if (c.client.connected())
+                              return false;
+                            log_v("client disconnected");
+                            c.client.stop();
+                            return true; });
 }
 
 bool initialize_video_provider()
 {
   log_v("initialize_video_provider");
-  unsigned long frameDuration = DEFAULT_FRAME_DURATION;
+  long frameDuration = DEFAULT_FRAME_DURATION;
   
   // Parse the frame duration from string to number
   if (strlen(param_frame_duration_value) > 0) {
     frameDuration = atol(param_frame_duration_value);
   }
   
-  log_i("Frame duration: %lu ms", frameDuration);
+  log_i("Frame duration: %ld ms", frameDuration);
   
   // Initialize SPIFFS if not already initialized
   if (!SPIFFS.begin(true)) {
@@ -212,6 +346,10 @@ bool initialize_video_provider()
     log_e("Failed to initialize video provider");
     return false;
   }
+
+  log_i("Frame clock: %lu ms", videoProvider.getFrameDuration());
+  videoProvider.setLiveEdge(param_live_edge.isChecked());
+  log_i("Live edge: %d", videoProvider.isLiveEdge());
   
   return true;
 }
@@ -219,14 +357,8 @@ bool initialize_video_provider()
 void start_rtsp_server()
 {
   log_v("start_rtsp_server");
-  unsigned long frameDuration = DEFAULT_FRAME_DURATION;
-  
-  // Parse the frame duration from string to number
-  if (strlen(param_frame_duration_value) > 0) {
-    frameDuration = atol(param_frame_duration_value);
-  }
-  
-  video_server = std::unique_ptr<rtsp_server_video>(new rtsp_server_video(videoProvider, frameDuration, RTSP_PORT));
+  // The frame rate is taken from the video provider, so it can change while running
+  video_server = std::unique_ptr<rtsp_server_video>(new rtsp_server_video(videoProvider, RTSP_PORT));
   // Add RTSP service to mDNS
   // HTTP is already set by iotWebConf
   MDNS.addService("rtsp", "tcp", RTSP_PORT);
@@ -245,17 +377,17 @@ void on_connected()
 void on_config_saved()
 {
   log_v("on_config_saved");
+  long frameDuration = DEFAULT_FRAME_DURATION;
+
   // Parse the frame duration from string to number
-  float fps = 10.0f; // Default
   if (strlen(param_frame_duration_value) > 0) {
-    unsigned long frameDuration = atol(param_frame_duration_value);
-    if (frameDuration > 0) {
-      fps = 1000.0f / frameDuration;
-    }
+    frameDuration = atol(param_frame_duration_value);
   }
-  
-  // Update settings
-  videoProvider.setFps(fps);
+
+  // Update settings; applied on the next frame by all RTSP and MJPEG clients
+  videoProvider.setFrameDuration(frameDuration);
+  videoProvider.setLiveEdge(param_live_edge.isChecked());
+  log_i("Frame duration: %ld ms (frame clock: %lu ms), live edge: %d", frameDuration, videoProvider.getFrameDuration(), param_live_edge.isChecked());
 }
 
 void setup()
@@ -294,6 +426,7 @@ void setup()
   // Add parameters to the group
   param_group_video.addItem(&param_frame_duration);
   param_group_video.addItem(&param_video_quality);
+  param_group_video.addItem(&param_live_edge);
   iotWebConf.addParameterGroup(&param_group_video);
 
   iotWebConf.getApTimeoutParameter()->visible = true;
@@ -308,7 +441,12 @@ void setup()
   }
 
   // Set up required URL handlers on the web server
+  calculate_index_html_etag();
+  const char *collect_headers[] = {"If-None-Match"};
+  web_server.collectHeaders(collect_headers, sizeof(collect_headers) / sizeof(collect_headers[0]));
   web_server.on("/", HTTP_GET, handle_root);
+  // Live status for the index page and monitoring
+  web_server.on("/api/status", HTTP_GET, handle_api_status);
   web_server.on("/config", []
                 { iotWebConf.handleConfig(); });
   // Video snapshot
@@ -326,4 +464,6 @@ void loop()
 
   if (video_server)
     video_server->doLoop();
+
+  stream_mjpeg_clients();
 }
\ No newline at end of file